@@ -48,6 +48,7 @@ int main() {
 4. std::shared_timed_mutex
 C++14 introduced std::shared_timed_mutex, which allows multiple threads to share a mutex for read access but provides exclusive access for writing. 
 This is useful for scenarios where many threads need to read data, but only one thread needs to write.
+For read-mostly data where readers should take no lock at all, see the Seqlock/RCU version of read_data()/write_data() in "Multithreading in cpp".
   #include <iostream>
 #include <thread>
 #include <shared_mutex>